@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include "TesseractCommonUtils.h"
+#include "LatencyStats.h"
 
 namespace TesseractCommon
 {
@@ -21,8 +22,15 @@ namespace TesseractCommon
         const uint8_t DRW_ZORD = 0x07; // DrawZOrderPixels
         const uint8_t DRW_XY_PXL = 0x08; // DrawXYPixel
         const uint8_t DRW_XY_RECT = 0x09; // DrawRect
+
+        const uint8_t CTRL_PROBE = 0x0A; // LatencyProbe
+        const uint8_t CTRL_SYNC = 0x0B; // Sync marker, see StreamSync.h
     }
 
+    static_assert(DrawCommandOpcode::CTRL_PROBE == LatencyProbeWire::OPCODE &&
+        DrawCommandOpcode::OPCODE_SIZE_BITS == LatencyProbeWire::OPCODE_SIZE_BITS,
+        "LatencyStats.h wire format out of sync with DrawCommandOpcode");
+
     struct DrawCommand
     {
         uint8_t opcode; // 6 bits
@@ -300,4 +308,48 @@ namespace TesseractCommon
             bitOffset += 8;
         }
     };
+
+    struct LatencyProbe
+    {
+        static const uint16_t PAYLOAD_SIZE_BITS = LatencyProbeWire::PAYLOAD_SIZE_BITS;
+
+        uint16_t probeId; // 16 bits
+        uint32_t timestamps[LatencyProbeStage::STAGE_COUNT]; // 32 bits each
+
+        void DecodeFromBitStream(uint8_t *data, size_t dataLen, size_t &bitOffset)
+        {
+            probeId = 0;
+            GetBitCompressedValue(data, dataLen, bitOffset, 16, probeId);
+            bitOffset += 16;
+
+            for (uint8_t stage = 0; stage < LatencyProbeStage::STAGE_COUNT; stage++)
+            {
+                timestamps[stage] = 0;
+                GetBitCompressedValue(data, dataLen, bitOffset, 32, timestamps[stage]);
+                bitOffset += 32;
+            }
+        }
+
+        void EncodeToBitStream(uint8_t *data, size_t dataLen, size_t &bitOffset)
+        {
+            SetBitCompressedValue(data, dataLen, bitOffset, 16, probeId);
+            bitOffset += 16;
+
+            for (uint8_t stage = 0; stage < LatencyProbeStage::STAGE_COUNT; stage++)
+            {
+                SetBitCompressedValue(data, dataLen, bitOffset, 32, timestamps[stage]);
+                bitOffset += 32;
+            }
+        }
+
+        // Overwrites one timestamp of an already encoded probe. payloadBitOffset points just past the opcode.
+        static void StampInPlace(uint8_t *data, size_t dataLen, size_t payloadBitOffset, uint8_t stage, uint32_t timestamp)
+        {
+            if (stage >= LatencyProbeStage::STAGE_COUNT) return;
+
+            size_t stampOffset = payloadBitOffset + 16 + 32 * stage;
+            ClearBitRange(data, dataLen, stampOffset, 32);
+            SetBitCompressedValue(data, dataLen, stampOffset, 32, timestamp);
+        }
+    };
 };
\ No newline at end of file
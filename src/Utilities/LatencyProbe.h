@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TesseractCommonUtils.h"
+#include "DrawCommand.h"
+
+namespace TesseractCommon
+{
+
+    #pragma region Probe Transport
+
+    // Probes are only recognised as the first command of a UDP packet, and GPU replies only in their
+    // SPI reply slot, so the bridge never has to walk the command stream to find them.
+
+    // Host side decoding and statistics live in LatencyStats.h
+
+    const size_t LATENCY_PROBE_SIZE_BYTES = LatencyProbeWire::SIZE_BYTES;
+
+    static_assert(LATENCY_PROBE_SIZE_BYTES <= SPI_REPLY_SLOT_SIZE, "Probe reply must fit its SPI reply slot");
+
+    bool IsLatencyProbe(uint8_t *data, size_t dataLen)
+    {
+        if (dataLen < LATENCY_PROBE_SIZE_BYTES) return false;
+
+        uint8_t opcode = 0;
+        GetBitCompressedValue(data, dataLen, 0, DrawCommandOpcode::OPCODE_SIZE_BITS, opcode);
+        return opcode == DrawCommandOpcode::CTRL_PROBE;
+    }
+
+#ifdef SPI_MASTER
+    // Stamps a probe returned by the GPU with replyReceivedAtMicros and sends it back to whoever
+    // sent the last UDP packet
+    void ForwardLatencyProbeReply(uint32_t replyReceivedAtMicros, WiFiUDP &udp = UdpConnection)
+    {
+        uint8_t *slot = GetSpiReplySlot(SpiReceiveBuffer, SpiReplySlot::LATENCY_PROBE);
+        if (!IsLatencyProbe(slot, SPI_REPLY_SLOT_SIZE)) return;
+
+        LatencyProbe::StampInPlace(slot, SPI_REPLY_SLOT_SIZE, DrawCommandOpcode::OPCODE_SIZE_BITS,
+            LatencyProbeStage::BRIDGE_REPLY_RX, replyReceivedAtMicros);
+
+        udp.beginPacket(udp.remoteIP(), udp.remotePort());
+        udp.write(slot, LATENCY_PROBE_SIZE_BYTES);
+        udp.endPacket();
+    }
+
+    // StreamDataToMasterBuffer that stamps probes on receive / transmit and forwards GPU replies.
+    // receivedAtMicros is micros() taken by the caller right after parsePacket() returned the packet.
+    void StreamDataToMasterBufferWithProbes(uint32_t receivedAtMicros, WiFiUDP &udp = UdpConnection)
+    {
+        auto bytesRead = ReadStreamToMasterBuffer(udp);
+        if (bytesRead < 1) return;
+
+        if (IsLatencyProbe(SpiSendBuffer, bytesRead))
+        {
+            LatencyProbe::StampInPlace(SpiSendBuffer, bytesRead, DrawCommandOpcode::OPCODE_SIZE_BITS,
+                LatencyProbeStage::BRIDGE_UDP_RX, receivedAtMicros);
+            LatencyProbe::StampInPlace(SpiSendBuffer, bytesRead, DrawCommandOpcode::OPCODE_SIZE_BITS,
+                LatencyProbeStage::BRIDGE_SPI_TX, micros());
+        }
+
+        TransferMasterBuffer(bytesRead);
+
+        ForwardLatencyProbeReply(micros(), udp);
+    }
+#else
+    // Places a probe in its reply slot so the bridge picks it up on the next transfer.
+    // The caller stamps GPU_SPI_RX when the transfer completes, then GPU_DECODE / GPU_PRESENT.
+    void WriteLatencyProbeReply(LatencyProbe &probe)
+    {
+        if (!SpiInitialized) return;
+
+        uint8_t *slot = GetSpiReplySlot(SpiSendBuffer, SpiReplySlot::LATENCY_PROBE);
+        memset(slot, 0, SPI_REPLY_SLOT_SIZE);
+
+        size_t bitOffset = 0;
+        SetBitCompressedValue(slot, SPI_REPLY_SLOT_SIZE, bitOffset, DrawCommandOpcode::OPCODE_SIZE_BITS, DrawCommandOpcode::CTRL_PROBE);
+        bitOffset += DrawCommandOpcode::OPCODE_SIZE_BITS;
+
+        probe.EncodeToBitStream(slot, SPI_REPLY_SLOT_SIZE, bitOffset);
+    }
+
+    // Call once the reply has been clocked out so the probe is not returned twice
+    void ClearLatencyProbeReply()
+    {
+        if (!SpiInitialized) return;
+
+        memset(GetSpiReplySlot(SpiSendBuffer, SpiReplySlot::LATENCY_PROBE), 0, SPI_REPLY_SLOT_SIZE);
+    }
+#endif
+
+    #pragma endregion
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+// Probe wire format and latency aggregation. Deliberately free of Arduino / ESP32 dependencies so a
+// desktop content source can build it to decode probe replies and keep the histograms.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace TesseractCommon
+{
+
+    #pragma region Probe Wire Format
+
+    // Timestamp slots in a LatencyProbe, in pipeline order. Each is micros() on the stamping device.
+    namespace LatencyProbeStage
+    {
+        const uint8_t SOURCE_TX = 0;       // Content source, before sending
+        const uint8_t BRIDGE_UDP_RX = 1;   // Bridge, UDP packet received
+        const uint8_t BRIDGE_SPI_TX = 2;   // Bridge, before SPI transfer
+        const uint8_t GPU_SPI_RX = 3;      // GPU, SPI transfer containing the probe completed
+        const uint8_t GPU_DECODE = 4;      // GPU, probe decoded
+        const uint8_t GPU_PRESENT = 5;     // GPU, frame containing the probe presented
+        const uint8_t BRIDGE_REPLY_RX = 6; // Bridge, reply read back from the SPI receive buffer
+
+        const uint8_t STAGE_COUNT = 7;
+    }
+
+    // Opcode (6 bits), probe id (16 bits), then one 32 bit timestamp per stage, packed LSB first
+    namespace LatencyProbeWire
+    {
+        const uint8_t OPCODE = 0x0A;
+        const uint8_t OPCODE_SIZE_BITS = 6;
+        const uint16_t PAYLOAD_SIZE_BITS = 16 + 32 * LatencyProbeStage::STAGE_COUNT;
+        const size_t SIZE_BYTES = (OPCODE_SIZE_BITS + PAYLOAD_SIZE_BITS + 7) >> 3;
+    }
+
+    struct LatencyProbeSample
+    {
+        uint16_t probeId;
+        uint32_t timestamps[LatencyProbeStage::STAGE_COUNT];
+    };
+
+    uint32_t ReadLatencyProbeBits(const uint8_t *data, size_t bitOffset, uint8_t numBits)
+    {
+        uint32_t value = 0;
+
+        for (uint8_t bitIdx = 0; bitIdx < numBits; bitIdx++)
+        {
+            size_t streamBit = bitOffset + bitIdx;
+            uint32_t bit = (data[streamBit >> 3] >> (streamBit & 7)) & 1;
+            value |= bit << bitIdx;
+        }
+
+        return value;
+    }
+
+    // Decodes a probe reply as forwarded by the bridge. Returns false if it is not a probe.
+    bool DecodeLatencyProbeReply(const uint8_t *data, size_t dataLen, LatencyProbeSample &sample)
+    {
+        if (dataLen < LatencyProbeWire::SIZE_BYTES) return false;
+        if (ReadLatencyProbeBits(data, 0, LatencyProbeWire::OPCODE_SIZE_BITS) != LatencyProbeWire::OPCODE) return false;
+
+        size_t bitOffset = LatencyProbeWire::OPCODE_SIZE_BITS;
+
+        sample.probeId = ReadLatencyProbeBits(data, bitOffset, 16);
+        bitOffset += 16;
+
+        for (uint8_t stage = 0; stage < LatencyProbeStage::STAGE_COUNT; stage++)
+        {
+            sample.timestamps[stage] = ReadLatencyProbeBits(data, bitOffset, 32);
+            bitOffset += 32;
+        }
+
+        return true;
+    }
+
+    #pragma endregion
+
+    #pragma region Latency Statistics
+
+    // Log-linear histogram of microsecond latencies: each power of two is split into 4 buckets,
+    // so any reported percentile is within 25% of the true value.
+    struct LatencyHistogram
+    {
+        static const uint8_t SUB_BUCKET_BITS = 2;
+        static const uint8_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static const uint8_t BUCKET_COUNT = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        uint32_t buckets[BUCKET_COUNT] = {};
+        uint32_t count = 0;
+        uint32_t maxMicros = 0;
+
+        static uint8_t GetBucketIdx(uint32_t latencyMicros)
+        {
+            if (latencyMicros < SUB_BUCKETS) return latencyMicros;
+
+            uint8_t msb = 0;
+            for (uint32_t remaining = latencyMicros >> 1; remaining > 0; remaining >>= 1)
+            {
+                msb++;
+            }
+
+            uint8_t subBucket = (latencyMicros >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+            return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+        }
+
+        // Largest value that lands in the bucket
+        static uint32_t GetBucketUpperBound(uint8_t bucketIdx)
+        {
+            if (bucketIdx < SUB_BUCKETS) return bucketIdx;
+
+            uint8_t msb = bucketIdx / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+            uint8_t subBucket = bucketIdx % SUB_BUCKETS;
+            uint32_t lowerBound = (uint32_t)(SUB_BUCKETS + subBucket) << (msb - SUB_BUCKET_BITS);
+            return lowerBound + ((uint32_t)1 << (msb - SUB_BUCKET_BITS)) - 1;
+        }
+
+        void Record(uint32_t latencyMicros)
+        {
+            buckets[GetBucketIdx(latencyMicros)]++;
+            count++;
+            if (latencyMicros > maxMicros) maxMicros = latencyMicros;
+        }
+
+        // percentile in 0..100, e.g. 99 for p99
+        uint32_t GetPercentile(uint8_t percentile) const
+        {
+            if (count == 0) return 0;
+
+            uint32_t target = ((uint64_t)count * percentile + 99) / 100;
+            if (target == 0) target = 1;
+
+            uint32_t seen = 0;
+            for (uint8_t bucketIdx = 0; bucketIdx < BUCKET_COUNT; bucketIdx++)
+            {
+                seen += buckets[bucketIdx];
+                if (seen < target) continue;
+
+                uint32_t upperBound = GetBucketUpperBound(bucketIdx);
+                return upperBound < maxMicros ? upperBound : maxMicros;
+            }
+
+            return maxMicros;
+        }
+
+        void Reset()
+        {
+            memset(buckets, 0, sizeof(buckets));
+            count = 0;
+            maxMicros = 0;
+        }
+    };
+
+    // Per-stage latencies of returned probes. Stamps from different devices are never subtracted
+    // from each other.
+    //
+    // The GPU reply only rides back on the next SPI transfer, which happens when the next UDP packet
+    // arrives. replyWait is the bridge side SPI round trip minus everything the GPU accounted for on its
+    // own clock, i.e. the SPI wire time both ways plus that idle gap. pipeline is the round trip without
+    // replyWait: network + bridge + all GPU time from transfer complete to present.
+    struct LatencyProbeStats
+    {
+        LatencyHistogram network;   // UDP source -> bridge and bridge -> source
+        LatencyHistogram bridge;    // BRIDGE_UDP_RX -> BRIDGE_SPI_TX
+        LatencyHistogram gpuQueue;  // GPU_SPI_RX -> GPU_DECODE
+        LatencyHistogram gpu;       // GPU_SPI_RX -> GPU_PRESENT
+        LatencyHistogram replyWait; // BRIDGE_SPI_TX -> BRIDGE_REPLY_RX, minus GPU time
+        LatencyHistogram pipeline;  // roundTrip minus replyWait
+        LatencyHistogram roundTrip; // SOURCE_TX -> reply received
+
+        bool hasLastProbe = false;
+        uint16_t lastProbeId = 0;
+
+        static uint32_t SaturatingSubtract(uint32_t lhs, uint32_t rhs)
+        {
+            return lhs > rhs ? lhs - rhs : 0;
+        }
+
+        void Record(const LatencyProbeSample &sample, uint32_t replyReceivedMicros)
+        {
+            const uint32_t *stamps = sample.timestamps;
+
+            uint32_t roundTripMicros = replyReceivedMicros - stamps[LatencyProbeStage::SOURCE_TX];
+            uint32_t bridgeSpanMicros = stamps[LatencyProbeStage::BRIDGE_REPLY_RX] - stamps[LatencyProbeStage::BRIDGE_UDP_RX];
+            uint32_t bridgeMicros = stamps[LatencyProbeStage::BRIDGE_SPI_TX] - stamps[LatencyProbeStage::BRIDGE_UDP_RX];
+            uint32_t gpuQueueMicros = stamps[LatencyProbeStage::GPU_DECODE] - stamps[LatencyProbeStage::GPU_SPI_RX];
+            uint32_t gpuMicros = stamps[LatencyProbeStage::GPU_PRESENT] - stamps[LatencyProbeStage::GPU_SPI_RX];
+
+            uint32_t spiRoundTripMicros = stamps[LatencyProbeStage::BRIDGE_REPLY_RX] - stamps[LatencyProbeStage::BRIDGE_SPI_TX];
+            uint32_t replyWaitMicros = SaturatingSubtract(spiRoundTripMicros, gpuMicros);
+
+            network.Record(SaturatingSubtract(roundTripMicros, bridgeSpanMicros));
+            bridge.Record(bridgeMicros);
+            gpuQueue.Record(gpuQueueMicros);
+            gpu.Record(gpuMicros);
+            replyWait.Record(replyWaitMicros);
+            pipeline.Record(SaturatingSubtract(roundTripMicros, replyWaitMicros));
+            roundTrip.Record(roundTripMicros);
+        }
+
+        // Decodes and records a reply packet as forwarded by the bridge. Returns false if it is not a probe.
+        bool RecordReply(const uint8_t *data, size_t dataLen, uint32_t replyReceivedMicros)
+        {
+            LatencyProbeSample sample;
+            if (!DecodeLatencyProbeReply(data, dataLen, sample)) return false;
+
+            // The GPU may hand the same reply back on more than one transfer
+            if (hasLastProbe && sample.probeId == lastProbeId) return true;
+            hasLastProbe = true;
+            lastProbeId = sample.probeId;
+
+            Record(sample, replyReceivedMicros);
+            return true;
+        }
+
+        void Reset()
+        {
+            network.Reset();
+            bridge.Reset();
+            gpuQueue.Reset();
+            gpu.Reset();
+            replyWait.Reset();
+            pipeline.Reset();
+            roundTrip.Reset();
+            hasLastProbe = false;
+        }
+    };
+
+    #pragma endregion
+}
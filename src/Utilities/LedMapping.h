@@ -0,0 +1,274 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace TesseractCommon
+{
+
+    #pragma region Morton Encoding
+
+    // Z-order addresses interleave the LED index (even bits) with the ray index (odd bits), 8 bits each
+
+    constexpr uint16_t SpreadBitsStep(uint16_t val, uint8_t shift, uint16_t mask)
+    {
+        return (val | (val << shift)) & mask;
+    }
+
+    constexpr uint16_t CompactBitsStep(uint16_t val, uint8_t shift, uint16_t mask)
+    {
+        return (val | (val >> shift)) & mask;
+    }
+
+    // 0b abcdefgh -> 0b 0a0b0c0d0e0f0g0h
+    constexpr uint16_t SpreadBits(uint8_t val)
+    {
+        return SpreadBitsStep(SpreadBitsStep(SpreadBitsStep(val, 4, 0x0F0F), 2, 0x3333), 1, 0x5555);
+    }
+
+    // Inverse of SpreadBits, odd bits are ignored
+    constexpr uint8_t CompactBits(uint16_t val)
+    {
+        return (uint8_t)CompactBitsStep(CompactBitsStep(CompactBitsStep(val & 0x5555, 1, 0x3333), 2, 0x0F0F), 4, 0x00FF);
+    }
+
+    constexpr uint16_t MortonEncode(uint8_t rayIdx, uint8_t ledIdx)
+    {
+        return (uint16_t)(SpreadBits(ledIdx) | (SpreadBits(rayIdx) << 1));
+    }
+
+    constexpr uint8_t MortonDecodeRay(uint16_t zOrder)
+    {
+        return CompactBits(zOrder >> 1);
+    }
+
+    constexpr uint8_t MortonDecodeLed(uint16_t zOrder)
+    {
+        return CompactBits(zOrder);
+    }
+
+    #pragma endregion
+
+    #pragma region Lookup Table Generation
+
+    // C++11 compatible compile time table generation. Index sequences are built by doubling
+    // so that template depth stays logarithmic in the table size.
+
+    template <size_t... Is>
+    struct IndexSequence {};
+
+    template <typename Lhs, typename Rhs>
+    struct ConcatIndexSequence;
+
+    template <size_t... Lhs, size_t... Rhs>
+    struct ConcatIndexSequence<IndexSequence<Lhs...>, IndexSequence<Rhs...>>
+    {
+        typedef IndexSequence<Lhs..., (sizeof...(Lhs) + Rhs)...> Type;
+    };
+
+    template <size_t N>
+    struct MakeIndexSequence
+    {
+        typedef typename ConcatIndexSequence<
+            typename MakeIndexSequence<N / 2>::Type,
+            typename MakeIndexSequence<N - N / 2>::Type>::Type Type;
+    };
+
+    template <>
+    struct MakeIndexSequence<0>
+    {
+        typedef IndexSequence<> Type;
+    };
+
+    template <>
+    struct MakeIndexSequence<1>
+    {
+        typedef IndexSequence<0> Type;
+    };
+
+    template <typename T, size_t N>
+    struct LookupTable
+    {
+        T values[N];
+
+        constexpr T operator[](size_t idx) const
+        {
+            return values[idx];
+        }
+
+        constexpr size_t size() const
+        {
+            return N;
+        }
+    };
+
+    // Generator must expose `static constexpr T At(size_t idx)`
+    template <typename T, typename Generator, size_t... Is>
+    constexpr LookupTable<T, sizeof...(Is)> GenerateLookupTable(IndexSequence<Is...>)
+    {
+        return LookupTable<T, sizeof...(Is)>{{ Generator::At(Is)... }};
+    }
+
+    template <typename T, size_t N, typename Generator>
+    constexpr LookupTable<T, N> GenerateLookupTable()
+    {
+        return GenerateLookupTable<T, Generator>(typename MakeIndexSequence<N>::Type());
+    }
+
+    #pragma endregion
+
+    #pragma region LED Mapping
+
+    const uint16_t INVALID_LED = 0xFFFF;
+
+    // Maps logical (rayIdx, ledIdx) and z-order addresses to physical LED indices.
+    // Rays are wired RAYS_PER_STRIP to a strip. SERPENTINE reverses every other ray within a strip.
+    // INTERLEAVED_STRIPS lays strips out side by side in memory (parallel output drivers), otherwise
+    // each strip occupies a contiguous block.
+    // All tables are constexpr and end up in flash.
+    template <
+        uint16_t RAY_COUNT,
+        uint16_t LEDS_PER_RAY,
+        uint16_t RAYS_PER_STRIP,
+        bool SERPENTINE = false,
+        bool INTERLEAVED_STRIPS = false
+    >
+    struct LedMap
+    {
+        static_assert(RAY_COUNT > 0 && LEDS_PER_RAY > 0, "LedMap: geometry must not be empty");
+        static_assert(RAY_COUNT <= 1024, "LedMap: rayIdx is 10 bits");
+        static_assert(LEDS_PER_RAY <= 256, "LedMap: ledIdx is 8 bits");
+        static_assert(RAYS_PER_STRIP > 0 && RAY_COUNT % RAYS_PER_STRIP == 0, "LedMap: rays must divide evenly into strips");
+        static_assert((uint32_t)RAY_COUNT * LEDS_PER_RAY < INVALID_LED, "LedMap: too many LEDs for 16 bit indices");
+
+        static constexpr uint16_t LED_COUNT = RAY_COUNT * LEDS_PER_RAY;
+        static constexpr uint16_t STRIP_COUNT = RAY_COUNT / RAYS_PER_STRIP;
+        static constexpr uint16_t LEDS_PER_STRIP = RAYS_PER_STRIP * LEDS_PER_RAY;
+
+        // Z-order addressing only covers rays that fit in 8 bits
+        static constexpr uint16_t Z_ORDER_RAY_COUNT = RAY_COUNT < 256 ? RAY_COUNT : 256;
+        static constexpr size_t Z_ORDER_SPAN = (size_t)MortonEncode(Z_ORDER_RAY_COUNT - 1, LEDS_PER_RAY - 1) + 1;
+
+        static constexpr uint16_t ComputePhysicalIndex(uint16_t rayIdx, uint16_t ledIdx)
+        {
+            return INTERLEAVED_STRIPS
+                ? (uint16_t)(ComputeStripPosition(rayIdx, ledIdx) * STRIP_COUNT + rayIdx / RAYS_PER_STRIP)
+                : (uint16_t)((rayIdx / RAYS_PER_STRIP) * LEDS_PER_STRIP + ComputeStripPosition(rayIdx, ledIdx));
+        }
+
+        static constexpr uint16_t ComputeStripPosition(uint16_t rayIdx, uint16_t ledIdx)
+        {
+            return (uint16_t)((rayIdx % RAYS_PER_STRIP) * LEDS_PER_RAY +
+                ((SERPENTINE && ((rayIdx % RAYS_PER_STRIP) & 1)) ? (LEDS_PER_RAY - 1 - ledIdx) : ledIdx));
+        }
+
+        struct LogicalToPhysicalGenerator
+        {
+            static constexpr uint16_t At(size_t logicalIdx)
+            {
+                return ComputePhysicalIndex(logicalIdx / LEDS_PER_RAY, logicalIdx % LEDS_PER_RAY);
+            }
+        };
+
+        struct ZOrderToPhysicalGenerator
+        {
+            static constexpr uint16_t At(size_t zOrder)
+            {
+                return (MortonDecodeRay(zOrder) < Z_ORDER_RAY_COUNT && MortonDecodeLed(zOrder) < LEDS_PER_RAY)
+                    ? ComputePhysicalIndex(MortonDecodeRay(zOrder), MortonDecodeLed(zOrder))
+                    : INVALID_LED;
+            }
+        };
+
+        static constexpr LookupTable<uint16_t, LED_COUNT> LogicalToPhysical =
+            GenerateLookupTable<uint16_t, LED_COUNT, LogicalToPhysicalGenerator>();
+
+        static constexpr LookupTable<uint16_t, Z_ORDER_SPAN> ZOrderToPhysical =
+            GenerateLookupTable<uint16_t, Z_ORDER_SPAN, ZOrderToPhysicalGenerator>();
+
+        // DrawXYPixel addressing. Returns INVALID_LED when out of range.
+        static uint16_t GetPhysicalIndex(uint16_t rayIdx, uint8_t ledIdx)
+        {
+            if (rayIdx >= RAY_COUNT || ledIdx >= LEDS_PER_RAY) return INVALID_LED;
+            return LogicalToPhysical.values[rayIdx * LEDS_PER_RAY + ledIdx];
+        }
+
+        // DrawZOrderPixels addressing. Returns INVALID_LED when out of range.
+        static uint16_t GetPhysicalIndex(uint16_t zOrder)
+        {
+            if (zOrder >= Z_ORDER_SPAN) return INVALID_LED;
+            return ZOrderToPhysical.values[zOrder];
+        }
+
+        // Walks the physical LEDs of every valid z-order address in zStart..zEnd (inclusive), in z-order.
+        // Cost is proportional to the range, addresses outside the geometry are skipped.
+        class ZOrderRangeIterator
+        {
+        public:
+            ZOrderRangeIterator(uint32_t zOrder, uint32_t zEnd)
+                : _zOrder(zOrder), _zEnd(zEnd)
+            {
+                SkipInvalid();
+            }
+
+            uint16_t operator*() const
+            {
+                return ZOrderToPhysical.values[_zOrder];
+            }
+
+            ZOrderRangeIterator &operator++()
+            {
+                _zOrder++;
+                SkipInvalid();
+                return *this;
+            }
+
+            bool operator!=(const ZOrderRangeIterator &other) const
+            {
+                return _zOrder != other._zOrder;
+            }
+
+        private:
+            uint32_t _zOrder;
+            uint32_t _zEnd; // Exclusive
+
+            void SkipInvalid()
+            {
+                while (_zOrder < _zEnd && ZOrderToPhysical.values[_zOrder] == INVALID_LED)
+                {
+                    _zOrder++;
+                }
+            }
+        };
+
+        struct ZOrderRange
+        {
+            uint32_t zStart;
+            uint32_t zEnd; // Exclusive, clamped to Z_ORDER_SPAN
+
+            ZOrderRangeIterator begin() const
+            {
+                return ZOrderRangeIterator(zStart, zEnd);
+            }
+
+            ZOrderRangeIterator end() const
+            {
+                return ZOrderRangeIterator(zEnd, zEnd);
+            }
+        };
+
+        // for (auto physicalIdx : Map::IterateZOrder(cmd.zStart, cmd.zEnd)) { ... }
+        static ZOrderRange IterateZOrder(uint16_t zStart, uint16_t zEnd)
+        {
+            uint32_t end = min((uint32_t)zEnd + 1, (uint32_t)Z_ORDER_SPAN);
+            return ZOrderRange{min((uint32_t)zStart, end), end};
+        }
+    };
+
+    template <uint16_t R, uint16_t L, uint16_t S, bool SP, bool IS>
+    constexpr LookupTable<uint16_t, LedMap<R, L, S, SP, IS>::LED_COUNT> LedMap<R, L, S, SP, IS>::LogicalToPhysical;
+
+    template <uint16_t R, uint16_t L, uint16_t S, bool SP, bool IS>
+    constexpr LookupTable<uint16_t, LedMap<R, L, S, SP, IS>::Z_ORDER_SPAN> LedMap<R, L, S, SP, IS>::ZOrderToPhysical;
+
+    #pragma endregion
+}
@@ -0,0 +1,460 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TesseractCommonUtils.h"
+#include "DrawCommand.h"
+
+namespace TesseractCommon
+{
+
+    #pragma region Sync Markers
+
+    // Optional framing for the command stream. Commands are grouped into segments, each preceded by a
+    // byte aligned marker:
+    //
+    //   byte 0    SYNC_MARKER_0, low 6 bits are the CTRL_SYNC opcode
+    //   byte 1    SYNC_MARKER_1
+    //   byte 2    frame id, chosen by the sender and reused when resending segments of that frame
+    //   byte 3    segment index
+    //   byte 4    segment count for the whole frame
+    //   byte 5-6  payload length in bytes, little endian
+    //   byte 7    CRC-8 over bytes 2-6 and the payload
+    //
+    // The payload holds bit packed commands starting at its first bit, zero padded to a byte.
+    // A corrupted segment only loses itself: the reader scans forward to the next valid marker.
+
+    const uint8_t SYNC_MARKER_0 = 0x80 | DrawCommandOpcode::CTRL_SYNC;
+    const uint8_t SYNC_MARKER_1 = 0x5A;
+    const size_t SYNC_HEADER_SIZE = 8;
+    const size_t SYNC_MAX_SEGMENTS = 256;
+
+    // CRC-8, polynomial 0x07
+    uint8_t UpdateCrc8(uint8_t crc, const uint8_t *data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            crc ^= data[i];
+            for (uint8_t bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+            }
+        }
+
+        return crc;
+    }
+
+    uint8_t GetSyncSegmentCrc(const uint8_t *header, size_t payloadLength)
+    {
+        uint8_t crc = UpdateCrc8(0, header + 2, 5);
+        return UpdateCrc8(crc, header + SYNC_HEADER_SIZE, payloadLength);
+    }
+
+    // Encodes commands into segments of commandsPerSegment commands each.
+    //
+    //   writer.Begin(SpiSendBuffer, SPI_BUFFER_SIZE, 8, frameId++);
+    //   writer.WriteCommand(DrawCommandOpcode::DRW_XY_PXL, pixel);
+    //   size_t length = writer.Finish();
+    //
+    // To resend part of a frame, pass the original frame's id and segment count to Begin and call
+    // SetNextSegmentIdx before the commands of each resent segment.
+    struct SyncSegmentWriter
+    {
+        uint8_t *data = nullptr;
+        size_t dataLen = 0;
+        size_t bitOffset = 0;
+
+        uint8_t commandsPerSegment = 1;
+        uint8_t commandsInSegment = 0;
+        uint8_t frameId = 0;
+        size_t segmentCount = 0;      // Segments written to this buffer
+        size_t frameSegmentCount = 0; // Minimum count stamped into every marker
+        size_t segmentIdxEnd = 0;     // One past the highest segment index written
+        size_t nextSegmentIdx = 0;
+        size_t markerByteOffset = 0;
+        bool segmentOpen = false;
+
+        // Rollback point for the command in progress
+        size_t commandBitOffset = 0;
+        bool commandOpenedSegment = false;
+
+        // Clears the buffer, SetBitCompressedValue only ORs bits in
+        void Begin(uint8_t *buffer, size_t bufferLen, uint8_t segmentCommands, uint8_t frame, size_t frameSegments = 0)
+        {
+            data = buffer;
+            dataLen = bufferLen;
+            bitOffset = 0;
+            commandsPerSegment = segmentCommands > 0 ? segmentCommands : 1;
+            commandsInSegment = 0;
+            frameId = frame;
+            segmentCount = 0;
+            frameSegmentCount = min(frameSegments, SYNC_MAX_SEGMENTS);
+            segmentIdxEnd = 0;
+            nextSegmentIdx = 0;
+            segmentOpen = false;
+
+            memset(data, 0, dataLen);
+        }
+
+        // Closes the open segment; the next command starts a segment with the given index
+        void SetNextSegmentIdx(uint8_t segmentIdx)
+        {
+            CloseSegment();
+            nextSegmentIdx = segmentIdx;
+        }
+
+        // Call before encoding each command. Returns false if there is no room for a new marker.
+        bool BeginCommand()
+        {
+            commandBitOffset = bitOffset;
+            commandOpenedSegment = !segmentOpen;
+
+            if (segmentOpen) return true;
+
+            size_t byteOffset = (bitOffset + 7) >> 3;
+            if (byteOffset + SYNC_HEADER_SIZE > dataLen) return false;
+            if (nextSegmentIdx >= SYNC_MAX_SEGMENTS) return false;
+
+            markerByteOffset = byteOffset;
+            data[byteOffset] = SYNC_MARKER_0;
+            data[byteOffset + 1] = SYNC_MARKER_1;
+            data[byteOffset + 2] = frameId;
+            data[byteOffset + 3] = nextSegmentIdx;
+
+            bitOffset = (byteOffset + SYNC_HEADER_SIZE) << 3;
+            commandsInSegment = 0;
+            segmentOpen = true;
+            return true;
+        }
+
+        // Call after encoding each command. If the command ran past the buffer it is rolled back,
+        // not counted, and false is returned. Closes the segment once it holds commandsPerSegment commands.
+        bool EndCommand()
+        {
+            if (bitOffset > (dataLen << 3))
+            {
+                ClearFrom(commandBitOffset);
+                bitOffset = commandBitOffset;
+                if (commandOpenedSegment) segmentOpen = false;
+                return false;
+            }
+
+            commandsInSegment++;
+
+            // The last segment absorbs everything once the index space is used up
+            if (commandsInSegment >= commandsPerSegment && data[markerByteOffset + 3] < SYNC_MAX_SEGMENTS - 1)
+            {
+                CloseSegment();
+            }
+
+            return true;
+        }
+
+        template <typename T>
+        bool WriteCommand(uint8_t opcode, T &command)
+        {
+            if (!BeginCommand()) return false;
+
+            SetBitCompressedValue(data, dataLen, bitOffset, DrawCommandOpcode::OPCODE_SIZE_BITS, opcode);
+            bitOffset += DrawCommandOpcode::OPCODE_SIZE_BITS;
+            command.EncodeToBitStream(data, dataLen, bitOffset);
+
+            return EndCommand();
+        }
+
+        void CloseSegment()
+        {
+            if (!segmentOpen) return;
+
+            size_t payloadEnd = (bitOffset + 7) >> 3;
+            size_t payloadLength = payloadEnd - (markerByteOffset + SYNC_HEADER_SIZE);
+
+            data[markerByteOffset + 5] = payloadLength & 0xFF;
+            data[markerByteOffset + 6] = payloadLength >> 8;
+
+            bitOffset = payloadEnd << 3;
+            nextSegmentIdx = data[markerByteOffset + 3] + 1;
+            segmentIdxEnd = max(segmentIdxEnd, nextSegmentIdx);
+            segmentCount++;
+            segmentOpen = false;
+        }
+
+        // Fills in the segment count and checksums. Returns the number of bytes to transmit.
+        // The count covers every index written, even if Begin was given a smaller frameSegments.
+        size_t Finish()
+        {
+            CloseSegment();
+
+            size_t markerSegmentCount = max(frameSegmentCount, segmentIdxEnd);
+
+            size_t byteOffset = 0;
+            for (size_t segmentIdx = 0; segmentIdx < segmentCount; segmentIdx++)
+            {
+                uint8_t *header = data + byteOffset;
+                size_t payloadLength = header[5] | (header[6] << 8);
+
+                header[4] = markerSegmentCount; // 256 wraps to 0
+                header[7] = GetSyncSegmentCrc(header, payloadLength);
+
+                byteOffset += SYNC_HEADER_SIZE + payloadLength;
+            }
+
+            return byteOffset;
+        }
+
+    private:
+        // Zeroes everything from fromBitOffset to the end of the buffer
+        void ClearFrom(size_t fromBitOffset)
+        {
+            size_t byteOffset = fromBitOffset >> 3;
+            uint8_t bitOffsetInByte = fromBitOffset & 7;
+
+            if (bitOffsetInByte > 0 && byteOffset < dataLen)
+            {
+                ClearBitRange(data, dataLen, fromBitOffset, 8 - bitOffsetInByte);
+                byteOffset++;
+            }
+
+            if (byteOffset < dataLen)
+            {
+                memset(data + byteOffset, 0, dataLen - byteOffset);
+            }
+        }
+    };
+
+    struct SyncSegment
+    {
+        uint8_t segmentIdx;
+        size_t bitStart; // First bit of the payload
+        size_t byteEnd;  // Use as dataLen when decoding so reads stay inside the segment
+    };
+
+    // Walks the valid segments of a received frame and records which ones were lost. Begin starts a new
+    // frame; Merge adds a resend of the same frame, yielding only segments not received yet and ignoring
+    // segments of any other frame.
+    //
+    //   SyncSegment segment;
+    //   while (reader.Next(segment))
+    //   {
+    //       size_t bitOffset = segment.bitStart;
+    //       // Decode commands with (data, segment.byteEnd, bitOffset) until opcode 0 or the end
+    //   }
+    struct SyncSegmentReader
+    {
+        uint8_t *data = nullptr;
+        size_t dataLen = 0;
+        size_t byteOffset = 0;
+
+        uint8_t frameId = 0;     // Valid once segmentCount > 0
+        size_t segmentCount = 0; // 0 until a valid marker has been seen
+        size_t segmentsFound = 0;
+        size_t bytesSkipped = 0; // Includes trailing padding when given more than the transfer length
+        uint8_t segmentsSeen[SYNC_MAX_SEGMENTS >> 3] = {};
+
+        void Begin(uint8_t *buffer, size_t bufferLen)
+        {
+            segmentCount = 0;
+            segmentsFound = 0;
+            memset(segmentsSeen, 0, sizeof(segmentsSeen));
+
+            Merge(buffer, bufferLen);
+        }
+
+        // Continues the current frame with another received buffer
+        void Merge(uint8_t *buffer, size_t bufferLen)
+        {
+            data = buffer;
+            dataLen = bufferLen;
+            byteOffset = 0;
+            bytesSkipped = 0;
+        }
+
+        bool Next(SyncSegment &segment)
+        {
+            while (byteOffset + SYNC_HEADER_SIZE <= dataLen)
+            {
+                if (segmentCount > 0 && segmentsFound >= segmentCount) return false;
+
+                if (IsValidMarker(byteOffset))
+                {
+                    uint8_t *header = data + byteOffset;
+                    size_t payloadLength = header[5] | (header[6] << 8);
+                    uint8_t segmentIdx = header[3];
+
+                    byteOffset += SYNC_HEADER_SIZE + payloadLength;
+
+                    if (segmentCount > 0 && header[2] != frameId) continue;
+                    if (IsSegmentSeen(segmentIdx)) continue;
+
+                    segment.segmentIdx = segmentIdx;
+                    segment.bitStart = (byteOffset - payloadLength) << 3;
+                    segment.byteEnd = byteOffset;
+
+                    frameId = header[2];
+                    segmentCount = max(segmentCount, (size_t)(header[4] > 0 ? header[4] : SYNC_MAX_SEGMENTS));
+                    segmentsSeen[segmentIdx >> 3] |= 1 << (segmentIdx & 7);
+                    segmentsFound++;
+
+                    return true;
+                }
+
+                byteOffset++;
+                bytesSkipped++;
+            }
+
+            return false;
+        }
+
+        bool IsSegmentSeen(uint8_t segmentIdx) const
+        {
+            return segmentsSeen[segmentIdx >> 3] & (1 << (segmentIdx & 7));
+        }
+
+        // No valid marker at all, the whole frame has to be resent
+        bool IsFrameLost() const
+        {
+            return segmentCount == 0;
+        }
+
+        // Call after Next has returned false. Writes up to maxCount lost segment indices, returns how many were lost.
+        size_t GetLostSegments(uint8_t *outSegmentIdxs, size_t maxCount) const
+        {
+            size_t lostCount = 0;
+
+            for (size_t segmentIdx = 0; segmentIdx < segmentCount; segmentIdx++)
+            {
+                if (IsSegmentSeen(segmentIdx)) continue;
+
+                if (lostCount < maxCount) outSegmentIdxs[lostCount] = segmentIdx;
+                lostCount++;
+            }
+
+            return lostCount;
+        }
+
+    private:
+        bool IsValidMarker(size_t markerOffset) const
+        {
+            uint8_t *header = data + markerOffset;
+
+            if (header[0] != SYNC_MARKER_0 || header[1] != SYNC_MARKER_1) return false;
+
+            size_t payloadLength = header[5] | (header[6] << 8);
+            if (markerOffset + SYNC_HEADER_SIZE + payloadLength > dataLen) return false;
+
+            if (header[4] != 0 && header[3] >= header[4]) return false;
+
+            return header[7] == GetSyncSegmentCrc(header, payloadLength);
+        }
+    };
+
+    #pragma endregion
+
+    #pragma region Loss Reports
+
+    // GPU -> bridge -> sender report of the segments a SyncSegmentReader has not received yet, staged in
+    // its own reply slot of the slave send buffer.
+    //
+    //   byte 0      SYNC_LOSS_REPORT_MARKER, low 6 bits are the CTRL_SYNC opcode
+    //   byte 1      frame id the report refers to
+    //   byte 2-3    frame segment count, little endian. 0 = no valid marker, resend the whole frame
+    //   byte 4-35   lost segment bitmask, bit (idx & 7) of byte 4 + (idx >> 3)
+
+    const uint8_t SYNC_LOSS_REPORT_MARKER = 0x40 | DrawCommandOpcode::CTRL_SYNC;
+    const size_t SYNC_LOSS_REPORT_SIZE = 4 + (SYNC_MAX_SEGMENTS >> 3);
+
+    static_assert(SYNC_LOSS_REPORT_SIZE <= SPI_REPLY_SLOT_SIZE, "Loss report must fit its SPI reply slot");
+
+    struct SyncLossReport
+    {
+        uint8_t frameId = 0;     // Meaningless when the whole frame was lost
+        size_t segmentCount = 0; // 0 means the whole frame was lost
+        uint8_t lostSegments[SYNC_MAX_SEGMENTS >> 3] = {};
+
+        void FromReader(const SyncSegmentReader &reader)
+        {
+            frameId = reader.frameId;
+            segmentCount = reader.segmentCount;
+            memset(lostSegments, 0, sizeof(lostSegments));
+
+            for (size_t segmentIdx = 0; segmentIdx < segmentCount; segmentIdx++)
+            {
+                if (reader.IsSegmentSeen(segmentIdx)) continue;
+                lostSegments[segmentIdx >> 3] |= 1 << (segmentIdx & 7);
+            }
+        }
+
+        bool IsFrameLost() const
+        {
+            return segmentCount == 0;
+        }
+
+        bool IsSegmentLost(uint8_t segmentIdx) const
+        {
+            return IsFrameLost() || (segmentIdx < segmentCount && (lostSegments[segmentIdx >> 3] & (1 << (segmentIdx & 7))));
+        }
+
+        // Returns bytes written, 0 if out is too small
+        size_t Encode(uint8_t *out, size_t outLen) const
+        {
+            if (outLen < SYNC_LOSS_REPORT_SIZE) return 0;
+
+            out[0] = SYNC_LOSS_REPORT_MARKER;
+            out[1] = frameId;
+            out[2] = segmentCount & 0xFF;
+            out[3] = segmentCount >> 8;
+            memcpy(out + 4, lostSegments, sizeof(lostSegments));
+            return SYNC_LOSS_REPORT_SIZE;
+        }
+
+        bool Decode(const uint8_t *data, size_t dataLen)
+        {
+            if (!IsSyncLossReport(data, dataLen)) return false;
+
+            frameId = data[1];
+            segmentCount = data[2] | (data[3] << 8);
+            if (segmentCount > SYNC_MAX_SEGMENTS) return false;
+
+            memcpy(lostSegments, data + 4, sizeof(lostSegments));
+            return true;
+        }
+
+        static bool IsSyncLossReport(const uint8_t *data, size_t dataLen)
+        {
+            return dataLen >= SYNC_LOSS_REPORT_SIZE && data[0] == SYNC_LOSS_REPORT_MARKER;
+        }
+    };
+
+#ifdef SPI_MASTER
+    // Sends a loss report returned by the GPU back to whoever sent the last UDP packet.
+    // Call after each transfer, e.g. after StreamDataToMasterBuffer.
+    void ForwardSyncLossReport(WiFiUDP &udp = UdpConnection)
+    {
+        uint8_t *slot = GetSpiReplySlot(SpiReceiveBuffer, SpiReplySlot::SYNC_LOSS_REPORT);
+        if (!SyncLossReport::IsSyncLossReport(slot, SPI_REPLY_SLOT_SIZE)) return;
+
+        udp.beginPacket(udp.remoteIP(), udp.remotePort());
+        udp.write(slot, SYNC_LOSS_REPORT_SIZE);
+        udp.endPacket();
+    }
+#else
+    // Stages the reader's loss report in its reply slot for the next transfer.
+    // Clear it with ClearSyncLossReport once it has been clocked out.
+    void WriteSyncLossReport(const SyncSegmentReader &reader)
+    {
+        if (!SpiInitialized) return;
+
+        SyncLossReport report;
+        report.FromReader(reader);
+        report.Encode(GetSpiReplySlot(SpiSendBuffer, SpiReplySlot::SYNC_LOSS_REPORT), SPI_REPLY_SLOT_SIZE);
+    }
+
+    void ClearSyncLossReport()
+    {
+        if (!SpiInitialized) return;
+
+        memset(GetSpiReplySlot(SpiSendBuffer, SpiReplySlot::SYNC_LOSS_REPORT), 0, SPI_REPLY_SLOT_SIZE);
+    }
+#endif
+
+    #pragma endregion
+}
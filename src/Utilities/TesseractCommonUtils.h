@@ -237,6 +237,30 @@ namespace TesseractCommon
         }
     }
 
+    // Zeroes numBits starting at bitOffset. SetBitCompressedValue only ORs bits in, so fields
+    // that are rewritten in place must be cleared first.
+    void ClearBitRange(uint8_t* data, size_t dataLen, size_t bitOffset, uint8_t numBits)
+    {
+        if (((bitOffset + numBits)) > (dataLen << 3))
+        {
+            // Serial.println("ERROR: ClearBitRange: Attempted to write outside of data buffer");
+            return;
+        }
+
+        while (numBits > 0)
+        {
+            size_t byteOffset = bitOffset >> 3;
+            uint8_t bitOffsetInByte = bitOffset - (byteOffset << 3);
+
+            size_t bitsForThisByte = min(numBits, uint8_t(8 - bitOffsetInByte));
+            auto andMask = GetLsbAndMask(bitsForThisByte);
+            data[byteOffset] &= ~(andMask << bitOffsetInByte);
+
+            bitOffset += bitsForThisByte;
+            numBits -= bitsForThisByte;
+        }
+    }
+
     #pragma endregion
 
     #pragma region WiFi
@@ -249,56 +273,233 @@ namespace TesseractCommon
     const size_t ConnectionTimeout = 5000;
 
 
+    // EstablishWiFiConnection returns immediately. The WiFi event handler only records link changes;
+    // the UDP stream is bound and re-bound on the loop side, from ServiceWiFiConnection or at the top
+    // of ReadStreamToMasterBuffer / StreamDataToMasterBuffer, so it is never torn down under a read.
+    // Firmware must call one of those every loop. Without ServiceWiFiConnection reconnects are left to
+    // the core's auto reconnect; calling it once per loop switches to the timeout / backoff state machine below.
+
+    // Reconnect backoff doubles after each failed attempt, starting at the min
+    const size_t ReconnectBackoffMinMs = 250;
+    const size_t ReconnectBackoffMaxMs = 8000;
+
+    namespace WiFiConnectionState
+    {
+        const uint8_t IDLE = 0;       // EstablishWiFiConnection not called yet
+        const uint8_t CONNECTING = 1; // Waiting on the link, gives up after ConnectionTimeout
+        const uint8_t CONNECTED = 2;  // Link up
+        const uint8_t BACKOFF = 3;    // Waiting before the next connection attempt
+    }
+
     WiFiServer *Server = nullptr;
     WiFiClient Client;
     WiFiUDP UdpConnection;
 
+    uint8_t WiFiState = WiFiConnectionState::IDLE;
+    unsigned long WiFiStateChangedAt = 0;
+    size_t WiFiBackoffMs = ReconnectBackoffMinMs;
+    bool WiFiServiceActive = false;
+    bool WiFiEventRegistered = false;
+
+    wifi_mode_t WiFiMode = WIFI_MODE_STA;
+    const char *WiFiSsid = SSID;
+    const char *WiFiPassword = Password;
+    size_t WiFiConnectTimeoutMs = ConnectionTimeout;
+
+    IPAddress UdpAddress = IpAddress;
+    int UdpPort = ConnectionPort;
+    bool UdpStreamRequested = false;
+    bool UdpStreamBound = false;
+    uint32_t UdpBoundGeneration = 0;
+
+    // Only written by the WiFi event task. Generation is bumped on every link up and drops on every
+    // link down, so a drop followed by a reconnect is never collapsed into "still up".
+    volatile bool WiFiLinkUp = false;
+    volatile uint32_t WiFiLinkGeneration = 0;
+    volatile uint32_t WiFiLinkDrops = 0;
+    uint32_t WiFiAttemptDrops = 0;
+
+    void BindUdpStream()
+    {
+        UdpStreamBound = UdpConnection.begin(UdpAddress, UdpPort) == 1;
+    }
+
+    void UnbindUdpStream()
+    {
+        if (!UdpStreamBound) return;
+
+        UdpConnection.stop();
+        UdpStreamBound = false;
+    }
+
+    // Binds the requested UDP stream to the current link, re-binding if the link has been re-established since.
+    // Loop side only, never from the WiFi event task.
+    void SyncUdpStream()
+    {
+        if (!UdpStreamRequested) return;
+
+        if (!WiFiLinkUp)
+        {
+            UnbindUdpStream();
+            return;
+        }
+
+        uint32_t generation = WiFiLinkGeneration;
+        if (UdpStreamBound && UdpBoundGeneration == generation) return;
+
+        UnbindUdpStream();
+        BindUdpStream();
+        UdpBoundGeneration = generation;
+    }
+
     void WiFiEvent(WiFiEvent_t event)
     {
         switch (event)
         {
-            
+            case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            case ARDUINO_EVENT_WIFI_AP_START:
+                WiFiLinkGeneration++;
+                WiFiLinkUp = true;
+                break;
+
+            case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            case ARDUINO_EVENT_WIFI_AP_STOP:
+                WiFiLinkDrops++;
+                WiFiLinkUp = false;
+                break;
+
+            default:
+                break;
         }
     }
 
+    void SetWiFiState(uint8_t state)
+    {
+        WiFiState = state;
+        WiFiStateChangedAt = millis();
+    }
+
+    void BeginWiFiAttempt()
+    {
+        WiFiAttemptDrops = WiFiLinkDrops;
+
+        if (WiFiMode == WIFI_MODE_STA)
+        {
+            WiFi.begin(WiFiSsid, WiFiPassword);
+        }
+        else if (WiFiMode == WIFI_MODE_AP)
+        {
+            WiFi.softAP(WiFiSsid, WiFiPassword);
+        }
+
+        SetWiFiState(WiFiConnectionState::CONNECTING);
+    }
+
+    // Advances the connection state machine. Never blocks, call once per loop.
+    void ServiceWiFiConnection()
+    {
+        if (!WiFiServiceActive)
+        {
+            // Reconnects are handled here from now on
+            WiFi.setAutoReconnect(false);
+            WiFiServiceActive = true;
+        }
+
+        SyncUdpStream();
+
+        unsigned long elapsed = millis() - WiFiStateChangedAt;
+
+        switch (WiFiState)
+        {
+            case WiFiConnectionState::CONNECTING:
+                if (WiFiLinkUp)
+                {
+                    WiFiBackoffMs = ReconnectBackoffMinMs;
+                    SetWiFiState(WiFiConnectionState::CONNECTED);
+                }
+                else if (WiFiLinkDrops != WiFiAttemptDrops || elapsed >= WiFiConnectTimeoutMs)
+                {
+                    WiFi.disconnect();
+                    SetWiFiState(WiFiConnectionState::BACKOFF);
+                }
+                break;
+
+            case WiFiConnectionState::CONNECTED:
+                if (!WiFiLinkUp)
+                {
+                    SetWiFiState(WiFiConnectionState::BACKOFF);
+                }
+                break;
+
+            case WiFiConnectionState::BACKOFF:
+                if (elapsed >= WiFiBackoffMs)
+                {
+                    WiFiBackoffMs = min(WiFiBackoffMs << 1, ReconnectBackoffMaxMs);
+                    BeginWiFiAttempt();
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    bool WiFiConnected()
+    {
+        return WiFiLinkUp;
+    }
+
+    // Starts connecting and returns immediately. A non-zero timeOutms additionally waits up to that long for the link.
     void EstablishWiFiConnection(
         wifi_mode_t mode = WIFI_MODE_STA,
         const char * hostname = HostName,
-        size_t timeOutms = ConnectionTimeout,
+        size_t timeOutms = 0,
         const char * ssid = SSID,
         const char * password = Password
         )
     {
-        WiFi.mode(WIFI_STA);
-        WiFi.setHostname(hostname);
+        WiFiMode = mode;
+        WiFiSsid = ssid;
+        WiFiPassword = password;
+        WiFiBackoffMs = ReconnectBackoffMinMs;
 
-        if (mode == WIFI_MODE_STA)
+        // Register once, before begin so no early events are missed
+        if (!WiFiEventRegistered)
         {
-            WiFi.begin(ssid, password);
-        }
-        else if (mode == WIFI_MODE_AP)
-        {
-            WiFi.softAP(ssid, password);
+            WiFi.onEvent(WiFiEvent);
+            WiFiEventRegistered = true;
         }
 
-        WiFi.onEvent(WiFiEvent);
+        WiFi.mode(mode);
+        WiFi.setHostname(hostname);
+
+        BeginWiFiAttempt();
 
         if (timeOutms > 0)
         {
             unsigned long startTime = millis();
-            while (WiFi.status() != WL_CONNECTED && (millis() - startTime) < timeOutms)
+            while (!WiFiConnected() && (millis() - startTime) < timeOutms)
             {
-                delay(100);
+                delay(10);
             }
         }
     }
 
+    // Binds now if the link is up, otherwise on the first loop side sync after it comes up.
+    // The stream is re-bound after every reconnect.
     void EstablishUdpStream(
         IPAddress addr = IpAddress,
         int port = ConnectionPort
     )
     {
-        UdpConnection.begin(addr, port);
+        UnbindUdpStream();
+
+        UdpAddress = addr;
+        UdpPort = port;
+        UdpStreamRequested = true;
+
+        SyncUdpStream();
     }
 
     
@@ -325,6 +526,27 @@ namespace TesseractCommon
     const size_t SPI_QUEUE_SIZE = 1;
     const size_t SPI_FREQUENCY = 1000000;
 
+    // Replies from the GPU to the bridge (probe replies, loss reports) each own a fixed slot at the
+    // start of the slave send buffer, so they never overwrite each other and can ride on the same
+    // transfer. Master transfers are padded to cover every slot.
+    const size_t SPI_REPLY_SLOT_SIZE = 48;
+
+    namespace SpiReplySlot
+    {
+        const size_t LATENCY_PROBE = 0;
+        const size_t SYNC_LOSS_REPORT = 1;
+
+        const size_t SLOT_COUNT = 2;
+    }
+
+    const size_t SPI_REPLY_AREA_SIZE = SPI_REPLY_SLOT_SIZE * SpiReplySlot::SLOT_COUNT;
+    static_assert(SPI_REPLY_AREA_SIZE <= SPI_BUFFER_SIZE, "SPI reply slots must fit in the SPI buffer");
+
+    uint8_t *GetSpiReplySlot(uint8_t *buffer, size_t slot)
+    {
+        return buffer + slot * SPI_REPLY_SLOT_SIZE;
+    }
+
     uint8_t *SpiReceiveBuffer = nullptr;
     uint8_t *SpiSendBuffer = nullptr;
 
@@ -401,27 +623,43 @@ namespace TesseractCommon
     }
     #endif
 
-    // Streams data from master to slave. The stream will be a udp connection
+    // Reads everything available on the stream into the send buffer. Returns the number of bytes read.
     #ifdef SPI_MASTER
-    void StreamDataToMasterBuffer(Stream &stream)
+    size_t ReadStreamToMasterBuffer(Stream &stream)
     {
-        if (!SpiInitialized) return;
+        if (!SpiInitialized) return 0;
+
+        SyncUdpStream();
 
         auto bytesAvailable = stream.available();
-        if (bytesAvailable < 1) return;
-        
-        if (bytesAvailable > 0)
+        if (bytesAvailable < 1) return 0;
 
-        {
-            memset(SpiSendBuffer, 0, SPI_BUFFER_SIZE + SPI_BUFFER_PADDING);
-            stream.readBytes(SpiSendBuffer, bytesAvailable);
-        }
+        memset(SpiSendBuffer, 0, SPI_BUFFER_SIZE + SPI_BUFFER_PADDING);
+        return stream.readBytes(SpiSendBuffer, min((size_t)bytesAvailable, SPI_BUFFER_SIZE));
+    }
+
+    // Transfers at least SPI_REPLY_AREA_SIZE bytes so every reply slot is read back; the send buffer
+    // is zeroed past the data by ReadStreamToMasterBuffer.
+    void TransferMasterBuffer(size_t length)
+    {
+        if (!SpiInitialized) return;
 
         digitalWrite(CS_PIN, LOW);
-        master.transfer(SpiSendBuffer, SpiReceiveBuffer, bytesAvailable);
+        master.transfer(SpiSendBuffer, SpiReceiveBuffer, max(length, SPI_REPLY_AREA_SIZE));
         digitalWrite(CS_PIN, HIGH);
     }
     #endif
 
+    // Streams data from master to slave. The stream will be a udp connection
+    #ifdef SPI_MASTER
+    void StreamDataToMasterBuffer(Stream &stream)
+    {
+        auto bytesRead = ReadStreamToMasterBuffer(stream);
+        if (bytesRead < 1) return;
+
+        TransferMasterBuffer(bytesRead);
+    }
+    #endif
+
     #pragma endregion
 }
\ No newline at end of file